@@ -2,6 +2,9 @@
 #include <fstream>
 #include <vector>
 #include <thread>
+#include <atomic>
+#include <sstream>
+#include <iomanip>
 
 #include "solver.h"
 
@@ -25,21 +28,91 @@ struct solver_parameters{
     float crossover_rate;
     float mutation_rate;
     int patience;
+    bool orderX = true; // order crossover, one-point crossover otherwise
+    bool steady_state = false; // steady-state evolution, generational otherwise
 } solver_pars;
 
+struct run_options{
+    bool allow_exact = true; // use the exact solver when the graph is small enough
+    bool compare = false; // run both solvers and report the GA optimality gap
+    string sweep_file; // parameter grid of the sweep mode (empty: no sweep)
+    string checkpoint_file; // prefix of the checkpoint files (empty: no checkpoints)
+    int checkpoint_interval = 10; // iterations between checkpoints
+    bool resume = false; // continue from the checkpoint files
+} run_opts;
+
+// values of each solver parameter explored by the sweep mode
+struct sweep_grid{
+    vector<int> population_sizes;
+    vector<float> crossover_rates;
+    vector<float> mutation_rates;
+    vector<int> patiences;
+    vector<bool> orderXs;
+    vector<bool> steady_states;
+    int seeds = 1;
+    bool halving = false; // successive halving, full grid otherwise
+};
+
+// result of one configuration averaged over users and seeds
+struct sweep_result{
+    solver_parameters pars;
+    double quality; // mean score relative to the best feasible score of each user (0 if infeasible)
+    double feasible_rate;
+    double mean_time; // [ms] per user
+    int front; // Pareto front of (quality, mean_time), 1 is not dominated
+};
+
 graph get_parameters(string type_1_instance);
 vector<user> get_users(string type_2_instance, int n);
-Solver::Solution solve_for_user(user user_info, graph graph_info, solver_parameters solver_pars, unsigned int seed);
+Solver::Solution solve_for_user(user user_info, graph graph_info, solver_parameters solver_pars, unsigned int seed, string checkpoint_file="");
+void compare_for_user(user user_info, graph graph_info, solver_parameters solver_pars, unsigned int seed);
 void print_solution(Solver::Solution solution, int available_time);
+sweep_grid get_sweep_grid(string sweep_file, solver_parameters defaults);
+vector<sweep_result> run_configurations(vector<solver_parameters> configurations, vector<user> users, int seeds, unsigned int seed);
+void assign_pareto_fronts(vector<sweep_result> &results);
+void print_sweep_results(vector<sweep_result> results);
+void sweep(sweep_grid grid, vector<user> users, unsigned int seed);
 
 int main(int argc, char** argv){
     // check input parameters
-    if (argc != 8) {
+    if (argc < 8) {
         cout << "Usage: " << argv[0] << " <type 1 instance> " << "<type 2 instance> " << "<max iterations> " 
-             << "<population_size> " << "<crossover rate> " << "<mutation rate> " << "<patience> " << endl;
+             << "<population_size> " << "<crossover rate> " << "<mutation rate> " << "<patience> "
+             << "[--ga] [--steady] [--compare] [--sweep <grid file>] "
+             << "[--checkpoint <file>] [--checkpoint-every <iterations>] [--resume]" << endl;
         return 1;
     }
 
+    // optional flags
+    for(int i = 8; i < argc; i++){
+        string flag = argv[i];
+        if(flag == "--ga"){
+            run_opts.allow_exact = false;
+        }
+        else if(flag == "--steady"){
+            solver_pars.steady_state = true;
+        }
+        else if(flag == "--compare"){
+            run_opts.compare = true;
+        }
+        else if(flag == "--sweep" && i + 1 < argc){
+            run_opts.sweep_file = argv[++i];
+        }
+        else if(flag == "--checkpoint" && i + 1 < argc){
+            run_opts.checkpoint_file = argv[++i];
+        }
+        else if(flag == "--checkpoint-every" && i + 1 < argc){
+            run_opts.checkpoint_interval = max(stoi(argv[++i]), 1);
+        }
+        else if(flag == "--resume"){
+            run_opts.resume = true;
+        }
+        else{
+            cout << "Unknown option " << flag << endl;
+            return 1;
+        }
+    }
+
     // get input parameters
     string type_1_instance = argv[1];
     string type_2_instance = argv[2];
@@ -49,6 +122,11 @@ int main(int argc, char** argv){
     solver_pars.mutation_rate = stof(argv[6]);
     solver_pars.patience = stoi(argv[7]);
 
+    if(run_opts.resume && run_opts.checkpoint_file.empty()){
+        cout << "--resume needs --checkpoint <file>" << endl;
+        return 1;
+    }
+
     // get graph parameters
     graph_info = get_parameters(type_1_instance);
 
@@ -59,13 +137,34 @@ int main(int argc, char** argv){
     vector<user> users;
     users = get_users(type_2_instance, graph_info.n);
 
+    // compare the GA against the exact solver
+    if(run_opts.compare){
+        for(unsigned long i=0; i < users.size(); i++){
+            cout << "User " << i + 1 << endl;
+            compare_for_user(users[i], graph_info, solver_pars, seed);
+            cout << "-----------------------------------"<<endl;
+        }
+        return 0;
+    }
+
+    // tune the GA parameters
+    if(!run_opts.sweep_file.empty()){
+        sweep(get_sweep_grid(run_opts.sweep_file, solver_pars), users, seed);
+        return 0;
+    }
+
     // solve for each user
     int n_users = users.size();
     vector<Solver::Solution> all_solutions(n_users);
     auto start = chrono::high_resolution_clock::now();
     for(int i=0; i < n_users; i++){
         Solver::Solution user_solution;
-        user_solution = solve_for_user(users[i], graph_info, solver_pars, seed);
+        string checkpoint_file;
+        if(!run_opts.checkpoint_file.empty()){
+            // one checkpoint per user
+            checkpoint_file = run_opts.checkpoint_file + "." + to_string(i + 1);
+        }
+        user_solution = solve_for_user(users[i], graph_info, solver_pars, seed, checkpoint_file);
         all_solutions[i] = user_solution;
     }
     auto end = chrono::high_resolution_clock::now();
@@ -151,7 +250,7 @@ vector<user> get_users(string type_2_instance, int n){
     return users;
 }
 
-Solver::Solution solve_for_user(user user_info, graph graph_info, solver_parameters solver_pars, unsigned int seed){
+Solver::Solution solve_for_user(user user_info, graph graph_info, solver_parameters solver_pars, unsigned int seed, string checkpoint_file){
     // initialize solver
     Solver s = Solver(graph_info.n, 
                       graph_info.node_dwell_times, 
@@ -159,20 +258,101 @@ Solver::Solution solve_for_user(user user_info, graph graph_info, solver_paramet
                       solver_pars.max_iterations, 
                       solver_pars.patience,
                       seed);
+    s.checkpoint_file = checkpoint_file;
+    s.checkpoint_interval = run_opts.checkpoint_interval;
+    s.resume = run_opts.resume;
 
-    // solve "reset" times
+    // small graphs are solved to optimality
     Solver::Solution solution;
+    if(run_opts.allow_exact && static_cast<unsigned long>(graph_info.n) <= s.exact_max_nodes){
+        solution = s.solve_exact(user_info.node_valuations,
+                                 user_info.edge_valuations,
+                                 user_info.available_time);
+        if(solution.feasible){
+            return solution;
+        }
+    }
+
+    if(solver_pars.steady_state){
+        return s.solve_steady_state(user_info.node_valuations,
+                                    user_info.edge_valuations,
+                                    user_info.available_time,
+                                    solver_pars.crossover_rate,
+                                    solver_pars.mutation_rate,
+                                    solver_pars.population_size,
+                                    solver_pars.orderX);
+    }
+
+    // solve "reset" times
     solution = s.solve(user_info.node_valuations,
                        user_info.edge_valuations, 
                        user_info.available_time,
                        solver_pars.crossover_rate,
                        solver_pars.mutation_rate, 
                        solver_pars.population_size,
-                       /*orderX*/true);
+                       solver_pars.orderX);
 
     return solution;
 }
 
+void compare_for_user(user user_info, graph graph_info, solver_parameters solver_pars, unsigned int seed){
+    Solver s = Solver(graph_info.n, 
+                      graph_info.node_dwell_times, 
+                      graph_info.edge_travel_times, 
+                      solver_pars.max_iterations, 
+                      solver_pars.patience,
+                      seed);
+
+    // generational and steady-state GA, same seed and parameters
+    Solver::Solution generational = s.solve(user_info.node_valuations,
+                                            user_info.edge_valuations, 
+                                            user_info.available_time,
+                                            solver_pars.crossover_rate,
+                                            solver_pars.mutation_rate, 
+                                            solver_pars.population_size,
+                                            solver_pars.orderX);
+    s.reset_seed();
+    Solver::Solution steady = s.solve_steady_state(user_info.node_valuations,
+                                                   user_info.edge_valuations, 
+                                                   user_info.available_time,
+                                                   solver_pars.crossover_rate,
+                                                   solver_pars.mutation_rate, 
+                                                   solver_pars.population_size,
+                                                   solver_pars.orderX);
+    vector<string> names = {"Generational", "Steady-State"};
+    vector<Solver::Solution> solutions = {generational, steady};
+
+    for(unsigned long i = 0; i < solutions.size(); i++){
+        cout << names[i] << " Score: " << solutions[i].fitness << (solutions[i].feasible ? "" : " (Infeasible)")
+             << " Time to Best: " << solutions[i].best_time.count() << "[ms]"
+             << " Time: " << solutions[i].exec_time.count() << "[ms]" << endl;
+    }
+
+    if(static_cast<unsigned long>(graph_info.n) > s.exact_max_nodes){
+        return;
+    }
+    Solver::Solution exact = s.solve_exact(user_info.node_valuations,
+                                           user_info.edge_valuations,
+                                           user_info.available_time);
+    cout << "Exact Score: " << exact.fitness << (exact.feasible ? "" : " (no feasible tour)")
+         << " Time: " << exact.exec_time.count() << "[ms]" << endl;
+    if(exact.feasible && exact.fitness > 0){
+        for(unsigned long i = 0; i < solutions.size(); i++){
+            cout << names[i] << " Gap: " << 100.0 * (exact.fitness - solutions[i].fitness) / exact.fitness << "%" << endl;
+            // a feasible GA tour can never beat the optimum
+            if(solutions[i].feasible && solutions[i].fitness > exact.fitness){
+                cout << "ERROR: " << names[i] << " score above the optimum" << endl;
+            }
+        }
+        // the exact tour must evaluate to the same score
+        Solver::Solution check = s.calculate_fitness(exact, user_info.node_valuations,
+                                                     user_info.edge_valuations, user_info.available_time);
+        if(!check.feasible || check.fitness != exact.fitness || check.tour_time != exact.tour_time){
+            cout << "ERROR: exact tour evaluates to " << check.fitness << endl;
+        }
+    }
+}
+
 void print_solution(Solver::Solution solution, int available_time)
 {
     cout<< "Score: " << solution.fitness << endl;
@@ -191,3 +371,257 @@ void print_solution(Solver::Solution solution, int available_time)
 }
 
 
+
+// reads the sweep grid, parameters that are not in the file keep the command line value
+// format: one parameter per line followed by its values, e.g. "population_size 500 1000 5000"
+// keys: population_size, crossover_rate, mutation_rate, patience, crossover (orderX/onepoint),
+// engine (generational/steady),
+// seeds (number of seeds per configuration), schedule (grid/halving)
+sweep_grid get_sweep_grid(string sweep_file, solver_parameters defaults){
+    ifstream file(sweep_file);
+    sweep_grid grid;
+
+    if (file.is_open()){
+        string line;
+        while(getline(file, line)){
+            istringstream values(line);
+            string key, value;
+            if(!(values >> key)){
+                continue;
+            }
+            while(values >> value){
+                if(key == "population_size"){
+                    grid.population_sizes.push_back(stoi(value));
+                }
+                else if(key == "crossover_rate"){
+                    grid.crossover_rates.push_back(stof(value));
+                }
+                else if(key == "mutation_rate"){
+                    grid.mutation_rates.push_back(stof(value));
+                }
+                else if(key == "patience"){
+                    grid.patiences.push_back(stoi(value));
+                }
+                else if(key == "crossover"){
+                    if(value != "orderX" && value != "onepoint"){
+                        cout << "Unknown crossover " << value << endl;
+                        exit(1);
+                    }
+                    grid.orderXs.push_back(value == "orderX");
+                }
+                else if(key == "engine"){
+                    if(value != "generational" && value != "steady"){
+                        cout << "Unknown engine " << value << endl;
+                        exit(1);
+                    }
+                    grid.steady_states.push_back(value == "steady");
+                }
+                else if(key == "seeds"){
+                    grid.seeds = max(stoi(value), 1);
+                }
+                else if(key == "schedule"){
+                    if(value != "grid" && value != "halving"){
+                        cout << "Unknown schedule " << value << endl;
+                        exit(1);
+                    }
+                    grid.halving = value == "halving";
+                }
+                else{
+                    cout << "Unknown sweep parameter " << key << endl;
+                    exit(1);
+                }
+            }
+        }
+        file.close();
+    }
+    else {
+        cout << "Unable to open file " << sweep_file << endl;
+        exit(1);
+    }
+
+    if(grid.population_sizes.empty()){
+        grid.population_sizes.push_back(defaults.population_size);
+    }
+    if(grid.crossover_rates.empty()){
+        grid.crossover_rates.push_back(defaults.crossover_rate);
+    }
+    if(grid.mutation_rates.empty()){
+        grid.mutation_rates.push_back(defaults.mutation_rate);
+    }
+    if(grid.patiences.empty()){
+        grid.patiences.push_back(defaults.patience);
+    }
+    if(grid.orderXs.empty()){
+        grid.orderXs.push_back(defaults.orderX);
+    }
+    if(grid.steady_states.empty()){
+        grid.steady_states.push_back(defaults.steady_state);
+    }
+
+    return grid;
+}
+
+// runs every (configuration, seed) pair on all the cores, the instance is shared between threads
+vector<sweep_result> run_configurations(vector<solver_parameters> configurations, vector<user> users, int seeds, unsigned int seed){
+    int n_users = users.size();
+    int jobs_per_configuration = seeds * n_users;
+    int n_jobs = configurations.size() * jobs_per_configuration;
+    vector<Solver::Solution> solutions(n_jobs);
+
+    atomic<int> next_job(0);
+    auto worker = [&](){
+        for(int job = next_job++; job < n_jobs; job = next_job++){
+            int c = job / jobs_per_configuration;
+            int s = (job % jobs_per_configuration) / n_users;
+            int u = job % n_users;
+            solutions[job] = solve_for_user(users[u], graph_info, configurations[c], seed + s);
+        }
+    };
+
+    int n_threads = max(1u, thread::hardware_concurrency());
+    vector<thread> threads;
+    for(int t = 0; t < min(n_threads, n_jobs); t++){
+        threads.push_back(thread(worker));
+    }
+    for(unsigned long t = 0; t < threads.size(); t++){
+        threads[t].join();
+    }
+
+    // best feasible score of each user, so every user weighs the same in the quality
+    vector<int> best_scores(n_users, 0);
+    for(int job = 0; job < n_jobs; job++){
+        if(solutions[job].feasible){
+            best_scores[job % n_users] = max(best_scores[job % n_users], solutions[job].fitness);
+        }
+    }
+
+    vector<sweep_result> results(configurations.size());
+    for(unsigned long c = 0; c < configurations.size(); c++){
+        double total_quality = 0, total_time = 0;
+        int feasible = 0;
+        for(int j = 0; j < jobs_per_configuration; j++){
+            Solver::Solution &solution = solutions[c * jobs_per_configuration + j];
+            int best_score = best_scores[j % n_users];
+            if(solution.feasible && best_score > 0){
+                total_quality += static_cast<double>(solution.fitness) / best_score;
+            }
+            total_time += solution.exec_time.count();
+            feasible += solution.feasible;
+        }
+        results[c] = sweep_result{configurations[c],
+                                  total_quality / jobs_per_configuration,
+                                  static_cast<double>(feasible) / jobs_per_configuration,
+                                  total_time / jobs_per_configuration,
+                                  0};
+    }
+    return results;
+}
+
+// non-dominated sorting on (quality, mean_time): front 1 are the configurations that no other
+// configuration beats in both, front 2 the ones only dominated by front 1 and so on
+void assign_pareto_fronts(vector<sweep_result> &results){
+    int assigned = 0;
+    for(int front = 1; assigned < static_cast<int>(results.size()); front++){
+        vector<unsigned long> current;
+        for(unsigned long a = 0; a < results.size(); a++){
+            if(results[a].front != 0){
+                continue;
+            }
+            bool dominated = false;
+            for(unsigned long b = 0; b < results.size() && !dominated; b++){
+                if(b == a || (results[b].front != 0 && results[b].front < front)){
+                    continue;
+                }
+                dominated = results[b].quality >= results[a].quality && results[b].mean_time <= results[a].mean_time &&
+                            (results[b].quality > results[a].quality || results[b].mean_time < results[a].mean_time);
+            }
+            if(!dominated){
+                current.push_back(a);
+            }
+        }
+        for(unsigned long i = 0; i < current.size(); i++){
+            results[current[i]].front = front;
+        }
+        assigned += current.size();
+    }
+}
+
+void print_sweep_results(vector<sweep_result> results){
+    cout << left << setw(10) << "iters" << setw(10) << "pop" << setw(10) << "cross" << setw(10) << "mut"
+         << setw(10) << "patience" << setw(10) << "crossover" << setw(14) << "engine" << setw(10) << "front"
+         << setw(12) << "quality" << setw(12) << "feasible" << "mean time[ms]" << endl;
+    for(unsigned long c = 0; c < results.size(); c++){
+        solver_parameters &pars = results[c].pars;
+        cout << left << setw(10) << pars.max_iterations << setw(10) << pars.population_size
+             << setw(10) << pars.crossover_rate << setw(10) << pars.mutation_rate << setw(10) << pars.patience
+             << setw(10) << (pars.orderX ? "orderX" : "onepoint")
+             << setw(14) << (pars.steady_state ? "steady" : "generational") << setw(10) << results[c].front
+             << setw(12) << results[c].quality << setw(12) << results[c].feasible_rate << results[c].mean_time << endl;
+    }
+}
+
+// evaluates the grid and prints the quality versus runtime of each configuration
+// with successive halving every rung doubles max_iterations (the last one uses the command line value)
+// and the Pareto-dominated configurations are dropped, keeping at most half of them for the next rung
+void sweep(sweep_grid grid, vector<user> users, unsigned int seed){
+    // tune the GA even if the exact solver could be used
+    run_opts.allow_exact = false;
+
+    vector<solver_parameters> configurations;
+    for(int population_size : grid.population_sizes){
+        for(float crossover_rate : grid.crossover_rates){
+            for(float mutation_rate : grid.mutation_rates){
+                for(int patience : grid.patiences){
+                    for(bool orderX : grid.orderXs){
+                        for(bool steady_state : grid.steady_states){
+                            solver_parameters pars = solver_pars;
+                            pars.population_size = population_size;
+                            pars.crossover_rate = crossover_rate;
+                            pars.mutation_rate = mutation_rate;
+                            pars.patience = patience;
+                            pars.orderX = orderX;
+                            pars.steady_state = steady_state;
+                            configurations.push_back(pars);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    int rungs = 1;
+    if(grid.halving){
+        while((1UL << rungs) < configurations.size() && (solver_pars.max_iterations >> rungs) > 0){
+            rungs++;
+        }
+    }
+
+    for(int rung = 0; rung < rungs; rung++){
+        for(unsigned long c = 0; c < configurations.size(); c++){
+            configurations[c].max_iterations = solver_pars.max_iterations >> (rungs - 1 - rung);
+        }
+        vector<sweep_result> results = run_configurations(configurations, users, grid.seeds, seed);
+
+        // non-dominated first, then best quality first, faster first on ties
+        assign_pareto_fronts(results);
+        sort(results.begin(), results.end(), [](const sweep_result &a, const sweep_result &b){
+            if(a.front != b.front){
+                return a.front < b.front;
+            }
+            return a.quality > b.quality || (a.quality == b.quality && a.mean_time < b.mean_time);
+        });
+        cout << "Rung " << rung + 1 << "/" << rungs << " (" << results.size() << " configurations, "
+             << grid.seeds << " seeds)" << endl;
+        print_sweep_results(results);
+        cout << "-----------------------------------"<<endl;
+
+        // keep the non-dominated configurations, at most half of them
+        configurations.clear();
+        for(unsigned long c = 0; c < (results.size() + 1) / 2; c++){
+            if(results[c].front > 1 && !configurations.empty()){
+                break;
+            }
+            configurations.push_back(results[c].pars);
+        }
+    }
+}
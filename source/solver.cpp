@@ -18,11 +18,19 @@ Solver::Solver(int n,
     // initialize random number generator with the fixed seed
     this->gen = mt19937(seed);
 
+    // checkpointing is disabled by default
+    this->checkpoint_interval = 10;
+    this->resume = false;
+
     // best solution
     this->best_solution = Solution{vector<int>(n-1), static_cast<unsigned long>(n-1), 0,0,true};
 } 
     
 Solver::~Solver() {
+    // wait for the last checkpoint to be written
+    if(this->checkpoint_writer && this->checkpoint_writer->joinable()){
+        this->checkpoint_writer->join();
+    }
 }
 
 void Solver::reset_seed()
@@ -299,6 +307,22 @@ Solver::Solution Solver::calculate_fitness(Solution solution,
     return Solution{solution.chromosome, solution.size, fitness, current_time, feasible};
 }
 
+// order crossover or 1 point crossover with reference list
+tuple<Solver::Solution, Solver::Solution> Solver::crossover(Solution parent1, Solution parent2, bool orderX)
+{
+    Solution child1,child2;
+    if(orderX){ // order crossover
+        tie(child1, child2) = order_crossover(parent1, parent2);
+    }
+    else {// 1 point with reference list crossover
+        tie(child1, child2) = onepoint_crossover(encode_solution(parent1), encode_solution(parent2));
+        // decode children
+        child1 = decode_solution(child1);
+        child2 = decode_solution(child2);
+    }
+    return make_tuple(child1, child2);
+}
+
 void Solver::initialize_population(){
     this->population.clear();
     for(int i = 0; i < this->population_size; i++){
@@ -331,13 +355,31 @@ Solver::Solution Solver::solve(vector<int>node_valuations,
 {
     auto start = chrono::high_resolution_clock::now();
 
-    this->population_size = population_size;
-    initialize_population();
-    this->best_solution = this->population[0];
-
-    int i;
+    int i = 0;
     int iterations_without_improvement = 0;
-    for(i=0; i < this->max_iterations;i++){
+    long iteration, counter;
+    bool done;
+    set_checkpoint_signature(false, node_valuations, edge_valuations, available_time, crossover_rate, mutation_rate, population_size, orderX);
+    if(this->resume && load_checkpoint(iteration, counter, done, start)){
+        if(done){
+            return this->best_solution;
+        }
+        i = iteration;
+        iterations_without_improvement = counter;
+    }
+    else{
+        this->population_size = population_size;
+        initialize_population();
+        this->best_solution = this->population[0];
+        this->best_solution.best_time = chrono::duration<double, milli>(0);
+    }
+
+    for(; i < this->max_iterations;i++){
+        // save the state at the start of the iteration
+        if(!this->checkpoint_file.empty() && i % this->checkpoint_interval == 0){
+            save_checkpoint(false, i, iterations_without_improvement, start);
+        }
+
         bool improvement_found = false;
 
         // calculate fitness for each solution
@@ -352,6 +394,7 @@ Solver::Solution Solver::solve(vector<int>node_valuations,
                 // update best_solution
                 this->best_solution = this->population[x];
                 this->best_solution.iteration = i;
+                this->best_solution.best_time = chrono::high_resolution_clock::now() - start;
                 //cout<<"new best solution: "<< this->best_solution.fitness <<endl;
             }
             total_fitness += this->population[x].fitness;
@@ -391,28 +434,9 @@ Solver::Solution Solver::solve(vector<int>node_valuations,
             double random_number = generate_canonical<double, 10>(this->gen);
             
             if (random_number < crossover_rate) {
-                // get parents
-                Solution parent1,parent2;
-                parent1 = selected_population[k-1];
-                parent2 = selected_population[k];
-
-                // encode parents
-                if(!orderX){
-                    parent1 = encode_solution(parent1);
-                    parent2 = encode_solution(parent2);
-                }
-
                 // perform crossover
                 Solution child1,child2;
-                if(orderX){ // order crossover
-                    tie(child1, child2) = order_crossover(parent1, parent2);
-                }
-                else {// 1 point with reference list crossover
-                    tie(child1, child2) = onepoint_crossover(parent1, parent2);
-                    // decode children
-                    child1 = decode_solution(child1);
-                    child2 = decode_solution(child2);
-                }
+                tie(child1, child2) = crossover(selected_population[k-1], selected_population[k], orderX);
 
                 // add children to population
                 offspring.push_back(child1);
@@ -445,5 +469,486 @@ Solver::Solution Solver::solve(vector<int>node_valuations,
     // save last iteration
     this->best_solution.last_iteration = i;
 
+    if(!this->checkpoint_file.empty()){
+        save_checkpoint(true, i, iterations_without_improvement, start);
+    }
+
+    return this->best_solution;
+}
+
+// binary tournament, index of the fitter of two random solutions
+int Solver::tournament_selection(){
+    int a = this->gen() % this->population_size;
+    int b = this->gen() % this->population_size;
+    return this->population[a].fitness >= this->population[b].fitness ? a : b;
+}
+
+// steady-state evolution: every step breeds two children from a tournament, evaluates only them
+// and each child replaces the worst solution of the population if it is better.
+// the population is ranked in a (fitness, index) set, so the worst and best are found in O(log P)
+// and the cost of a step does not depend on the population size.
+// the budget is max_iterations * population_size evaluations and the run stops after
+// patience * population_size evaluations without improvement, the iteration of a solution is its evaluation
+Solver::Solution Solver::solve_steady_state(vector<int> node_valuations,
+                                            vector<vector<int>> edge_valuations,
+                                            int available_time,
+                                            float crossover_rate,
+                                            float mutation_rate,
+                                            int population_size,
+                                            bool orderX)
+{
+    auto start = chrono::high_resolution_clock::now();
+
+    long evaluation, last_improvement;
+    bool done;
+    set<pair<int, int>> ranking; // (fitness, index in population)
+    set_checkpoint_signature(true, node_valuations, edge_valuations, available_time, crossover_rate, mutation_rate, population_size, orderX);
+    if(this->resume && load_checkpoint(evaluation, last_improvement, done, start)){
+        if(done){
+            return this->best_solution;
+        }
+        for(int x = 0; x < this->population_size; x++){
+            ranking.insert(make_pair(this->population[x].fitness, x));
+        }
+    }
+    else{
+        this->population_size = population_size;
+        initialize_population();
+
+        // evaluate the initial population
+        for(int x = 0; x < this->population_size; x++){
+            this->population[x] = calculate_fitness(this->population[x], node_valuations, edge_valuations, available_time);
+            ranking.insert(make_pair(this->population[x].fitness, x));
+        }
+        this->best_solution = this->population[ranking.rbegin()->second];
+        this->best_solution.iteration = 0;
+        this->best_solution.best_time = chrono::high_resolution_clock::now() - start;
+
+        evaluation = this->population_size;
+        last_improvement = evaluation;
+    }
+
+    long max_evaluations = static_cast<long>(this->max_iterations) * this->population_size;
+    long patience_evaluations = static_cast<long>(this->patience) * this->population_size;
+    long checkpoint_evaluations = static_cast<long>(this->checkpoint_interval) * this->population_size;
+    long next_checkpoint = evaluation;
+    while(evaluation < max_evaluations && evaluation - last_improvement < patience_evaluations){
+        // save the state every checkpoint_interval * population_size evaluations
+        if(!this->checkpoint_file.empty() && evaluation >= next_checkpoint){
+            save_checkpoint(false, evaluation, last_improvement, start);
+            next_checkpoint = evaluation + checkpoint_evaluations;
+        }
+
+        // selection phase
+        Solution parent1 = this->population[tournament_selection()];
+        Solution parent2 = this->population[tournament_selection()];
+
+        // crossover phase
+        Solution children[2] = {parent1, parent2};
+        double random_number = generate_canonical<double, 10>(this->gen);
+        if (random_number < crossover_rate) {
+            tie(children[0], children[1]) = crossover(parent1, parent2, orderX);
+        }
+
+        for(int c = 0; c < 2 && evaluation < max_evaluations; c++){
+            // mutation phase
+            random_number = generate_canonical<double, 10>(this->gen);
+            if (random_number < mutation_rate) {
+                children[c] = mutate(children[c]);
+            }
+
+            // evaluate only the child
+            Solution child = calculate_fitness(children[c], node_valuations, edge_valuations, available_time);
+            evaluation++;
+            if(child.fitness > this->best_solution.fitness){
+                last_improvement = evaluation;
+                this->best_solution = child;
+                this->best_solution.iteration = evaluation;
+                this->best_solution.best_time = chrono::high_resolution_clock::now() - start;
+            }
+
+            // replace the worst solution in place
+            set<pair<int, int>>::iterator worst = ranking.begin();
+            if(child.fitness > worst->first){
+                int index = worst->second;
+                ranking.erase(worst);
+                this->population[index] = child;
+                ranking.insert(make_pair(child.fitness, index));
+            }
+        }
+    }
+
+    // calculate execution times
+    auto end = chrono::high_resolution_clock::now();
+    this->best_solution.exec_time = end - start;
+
+    // save last evaluation
+    this->best_solution.last_iteration = evaluation;
+
+    if(!this->checkpoint_file.empty()){
+        save_checkpoint(true, evaluation, last_improvement, start);
+    }
+
     return this->best_solution;
-}
\ No newline at end of file
+}
+
+// checkpoint format (native byte order):
+// "EPTP" version signature done iteration counter elapsed[ms] rng_state best_solution population_size population
+// the signature identifies the run (engine, instance and parameters), a checkpoint is only resumed by the same run.
+// iteration and counter are the iteration and patience counter of the engine
+static const char checkpoint_magic[4] = {'E', 'P', 'T', 'P'};
+static const int checkpoint_version = 3;
+
+template <typename T>
+static void write_value(string &buffer, T value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_value(istream &file, T &value)
+{
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+// FNV-1a hash of a list of values
+static void hash_values(unsigned long long &hash, const vector<int> &values)
+{
+    for(unsigned long i = 0; i < values.size(); i++){
+        hash ^= static_cast<unsigned int>(values[i]);
+        hash *= 1099511628211ULL;
+    }
+}
+
+static void write_solution(string &buffer, const Solver::Solution &solution)
+{
+    write_value<unsigned long>(buffer, solution.size);
+    write_value<unsigned long>(buffer, solution.chromosome.size());
+    buffer.append(reinterpret_cast<const char*>(solution.chromosome.data()), solution.chromosome.size() * sizeof(int));
+    write_value<int>(buffer, solution.fitness);
+    write_value<int>(buffer, solution.tour_time);
+    write_value<bool>(buffer, solution.feasible);
+    write_value<long>(buffer, solution.iteration);
+    write_value<long>(buffer, solution.last_iteration);
+    write_value<double>(buffer, solution.exec_time.count());
+    write_value<double>(buffer, solution.best_time.count());
+}
+
+// returns false if the solution is truncated or is not a valid chromosome of nodes 1..n-1
+static bool read_solution(istream &file, Solver::Solution &solution, unsigned long n)
+{
+    unsigned long chromosome_size;
+    double exec_time, best_time;
+    if(!read_value(file, solution.size) || !read_value(file, chromosome_size) || 
+       chromosome_size == 0 || chromosome_size >= n || solution.size != chromosome_size){
+        return false;
+    }
+    solution.chromosome.resize(chromosome_size);
+    if(!file.read(reinterpret_cast<char*>(solution.chromosome.data()), chromosome_size * sizeof(int))){
+        return false;
+    }
+    for(unsigned long i = 0; i < chromosome_size; i++){
+        if(solution.chromosome[i] < 1 || static_cast<unsigned long>(solution.chromosome[i]) >= n){
+            return false;
+        }
+    }
+    if(!read_value(file, solution.fitness) || !read_value(file, solution.tour_time) || 
+       !read_value(file, solution.feasible) || !read_value(file, solution.iteration) || 
+       !read_value(file, solution.last_iteration) || !read_value(file, exec_time) || !read_value(file, best_time)){
+        return false;
+    }
+    solution.exec_time = chrono::duration<double, milli>(exec_time);
+    solution.best_time = chrono::duration<double, milli>(best_time);
+    return true;
+}
+
+// the mt19937 state words, in the order of its textual representation
+static void write_rng(string &buffer, const mt19937 &gen)
+{
+    stringstream rng_state;
+    rng_state << gen;
+    vector<unsigned int> words;
+    unsigned long word;
+    while(rng_state >> word){
+        words.push_back(static_cast<unsigned int>(word));
+    }
+    write_value<unsigned long>(buffer, words.size());
+    buffer.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(unsigned int));
+}
+
+static bool read_rng(istream &file, mt19937 &gen)
+{
+    unsigned long n_words;
+    if(!read_value(file, n_words) || n_words > mt19937::state_size + 1){
+        return false;
+    }
+    vector<unsigned int> words(n_words);
+    if(!file.read(reinterpret_cast<char*>(words.data()), n_words * sizeof(unsigned int))){
+        return false;
+    }
+    stringstream rng_state;
+    for(unsigned long i = 0; i < n_words; i++){
+        rng_state << words[i] << " ";
+    }
+    rng_state >> gen;
+    return static_cast<bool>(rng_state);
+}
+
+// identifies the run that writes or resumes the checkpoint
+void Solver::set_checkpoint_signature(bool steady_state,
+                                      vector<int> node_valuations,
+                                      vector<vector<int>> edge_valuations,
+                                      int available_time,
+                                      float crossover_rate,
+                                      float mutation_rate,
+                                      int population_size,
+                                      bool orderX)
+{
+    // instance hash
+    unsigned long long hash = 14695981039346656037ULL;
+    hash_values(hash, this->node_dwell_times);
+    for(unsigned long i = 0; i < this->edge_travel_times.size(); i++){
+        hash_values(hash, this->edge_travel_times[i]);
+    }
+    hash_values(hash, node_valuations);
+    for(unsigned long i = 0; i < edge_valuations.size(); i++){
+        hash_values(hash, edge_valuations[i]);
+    }
+
+    this->checkpoint_signature.clear();
+    write_value<bool>(this->checkpoint_signature, steady_state);
+    write_value<unsigned long>(this->checkpoint_signature, this->n);
+    write_value<int>(this->checkpoint_signature, this->max_iterations);
+    write_value<int>(this->checkpoint_signature, this->patience);
+    write_value<unsigned int>(this->checkpoint_signature, this->seed);
+    write_value<float>(this->checkpoint_signature, crossover_rate);
+    write_value<float>(this->checkpoint_signature, mutation_rate);
+    write_value<int>(this->checkpoint_signature, population_size);
+    write_value<bool>(this->checkpoint_signature, orderX);
+    write_value<int>(this->checkpoint_signature, available_time);
+    write_value<unsigned long long>(this->checkpoint_signature, hash);
+}
+
+// copies the solver state to a buffer and writes it to checkpoint_file in the background
+// the file is written to a temporary file and renamed, so a killed process never leaves a broken checkpoint
+void Solver::save_checkpoint(bool done, 
+                             long iteration, 
+                             long counter, 
+                             chrono::high_resolution_clock::time_point start)
+{
+    chrono::duration<double, milli> elapsed = chrono::high_resolution_clock::now() - start;
+
+    // snapshot
+    shared_ptr<string> buffer = make_shared<string>();
+    buffer->append(checkpoint_magic, sizeof(checkpoint_magic));
+    write_value<int>(*buffer, checkpoint_version);
+    buffer->append(this->checkpoint_signature);
+    write_value<bool>(*buffer, done);
+    write_value<long>(*buffer, iteration);
+    write_value<long>(*buffer, counter);
+    write_value<double>(*buffer, elapsed.count());
+    write_rng(*buffer, this->gen);
+    write_solution(*buffer, this->best_solution);
+    write_value<unsigned long>(*buffer, this->population.size());
+    for(unsigned long i = 0; i < this->population.size(); i++){
+        write_solution(*buffer, this->population[i]);
+    }
+
+    // only one write at a time, the previous one is usually finished by now
+    if(this->checkpoint_writer && this->checkpoint_writer->joinable()){
+        this->checkpoint_writer->join();
+    }
+    string checkpoint_file = this->checkpoint_file;
+    this->checkpoint_writer = make_shared<thread>([buffer, checkpoint_file](){
+        string temporary_file = checkpoint_file + ".tmp";
+        ofstream file(temporary_file, ios::binary | ios::trunc);
+        file.write(buffer->data(), buffer->size());
+        file.close();
+        if(!file || rename(temporary_file.c_str(), checkpoint_file.c_str()) != 0){
+            cout << "Unable to write checkpoint " << checkpoint_file << endl;
+        }
+    });
+}
+
+// restores the solver state from checkpoint_file and moves start back by the elapsed time
+// returns false (and the solver starts from scratch) if there is no valid checkpoint of this run
+bool Solver::load_checkpoint(long &iteration, 
+                             long &counter, 
+                             bool &done, 
+                             chrono::high_resolution_clock::time_point &start)
+{
+    ifstream file(this->checkpoint_file, ios::binary);
+    if(!file.is_open()){
+        return false;
+    }
+
+    char magic[4];
+    int version;
+    string signature(this->checkpoint_signature.size(), ' ');
+    unsigned long checkpoint_population_size;
+    double elapsed;
+    mt19937 gen;
+    Solution best;
+    vector<Solution> population;
+    file.read(magic, sizeof(magic));
+    bool valid = file && equal(magic, magic + 4, checkpoint_magic) &&
+                 read_value(file, version) && version == checkpoint_version &&
+                 file.read(&signature[0], signature.size()) && signature == this->checkpoint_signature &&
+                 read_value(file, done) && read_value(file, iteration) && read_value(file, counter) && 
+                 read_value(file, elapsed) && read_rng(file, gen) && read_solution(file, best, this->n) && 
+                 read_value(file, checkpoint_population_size) && checkpoint_population_size > 0;
+    for(unsigned long i = 0; valid && i < checkpoint_population_size; i++){
+        Solution solution;
+        valid = read_solution(file, solution, this->n);
+        population.push_back(solution);
+    }
+    if(!valid){
+        cout << "Invalid checkpoint " << this->checkpoint_file << ", starting from scratch" << endl;
+        return false;
+    }
+
+    this->gen = gen;
+    this->best_solution = best;
+    this->population = population;
+    this->population_size = population.size();
+    start -= chrono::duration_cast<chrono::high_resolution_clock::duration>(chrono::duration<double, milli>(elapsed));
+    return true;
+}
+
+// adds label to the Pareto set of (time, fitness) labels, dropping the ones it dominates
+// returns false if label is dominated by a label already in the set
+bool Solver::insert_label(vector<Label> &labels, Label label)
+{
+    for(unsigned long i = 0; i < labels.size(); i++){
+        if(labels[i].time <= label.time && labels[i].fitness >= label.fitness){
+            return false;
+        }
+    }
+    labels.erase(remove_if(labels.begin(), labels.end(), [&label](const Label &l){
+                     return label.time <= l.time && label.fitness >= l.fitness;
+                 }), labels.end());
+    labels.push_back(label);
+    return true;
+}
+
+// exact labelling dynamic program over (visited subset, last node)
+// every state keeps only its Pareto-optimal (time, fitness) labels, so the best feasible tour is
+// optimal. Memory grows as 2^(n-1) * (n-1), use it only for n <= exact_max_nodes.
+// returns an infeasible empty solution if there is no feasible tour
+Solver::Solution Solver::solve_exact(vector<int> node_valuations,
+                                     vector<vector<int>> edge_valuations,
+                                     int available_time)
+{
+    auto start = chrono::high_resolution_clock::now();
+
+    // node v (1..n-1) is the bit v-1 of the subset
+    unsigned long m = this->n - 1;
+    unsigned long n_subsets = 1UL << m;
+
+    // lower bound of the time needed to go back to the starting node
+    int return_bound = -1;
+    for(unsigned long j = 1; j < this->n; j++){
+        int edge_time = this->edge_travel_times[j][this->starting_node];
+        if(edge_time > 0 && (return_bound < 0 || edge_time < return_bound)){
+            return_bound = edge_time;
+        }
+    }
+
+    chrono::duration<double, milli> no_time(0);
+    Solution best = Solution{vector<int>(), 0, 0, 0, false, no_time, 0, 0, no_time};
+    if(return_bound < 0){
+        best.exec_time = chrono::high_resolution_clock::now() - start;
+        best.best_time = best.exec_time;
+        return best;
+    }
+
+    // labels of state (subset, last) are stored at subset * m + last - 1
+    vector<vector<Label>> labels(n_subsets * m);
+
+    // tours with a single node
+    int start_time = this->node_dwell_times[this->starting_node];
+    int start_fitness = node_valuations[this->starting_node];
+    for(unsigned long v = 1; v < this->n; v++){
+        int edge_time = this->edge_travel_times[this->starting_node][v];
+        if(edge_time <= 0){
+            continue;
+        }
+        Label label;
+        label.time = start_time + edge_time + this->node_dwell_times[v];
+        label.fitness = start_fitness + edge_valuations[this->starting_node][v] + node_valuations[v];
+        label.prev_last = -1;
+        label.prev_label = -1;
+        if(label.time + return_bound <= available_time){
+            insert_label(labels[(1UL << (v - 1)) * m + v - 1], label);
+        }
+    }
+
+    // every predecessor of a subset is numerically smaller, so its labels are final when it is expanded
+    int best_last = -1;
+    unsigned long best_subset = 0;
+    int best_label = -1;
+    for(unsigned long subset = 1; subset < n_subsets; subset++){
+        for(unsigned long last = 1; last < this->n; last++){
+            const vector<Label> &state = labels[subset * m + last - 1];
+            if(state.empty()){
+                continue;
+            }
+            int return_time = this->edge_travel_times[last][this->starting_node];
+            for(unsigned long k = 0; k < state.size(); k++){
+                const Label &label = state[k];
+
+                // close the tour
+                if(return_time > 0 && label.time + return_time <= available_time){
+                    int fitness = label.fitness + edge_valuations[last][this->starting_node];
+                    if(best_label < 0 || fitness > best.fitness){
+                        best.fitness = fitness;
+                        best.tour_time = label.time + return_time;
+                        best_last = last;
+                        best_subset = subset;
+                        best_label = k;
+                    }
+                }
+
+                // extend the tour
+                for(unsigned long next = 1; next < this->n; next++){
+                    int edge_time = this->edge_travel_times[last][next];
+                    if(subset & (1UL << (next - 1)) || edge_time <= 0){
+                        continue;
+                    }
+                    Label extended;
+                    extended.time = label.time + edge_time + this->node_dwell_times[next];
+                    if(extended.time + return_bound > available_time){
+                        continue;
+                    }
+                    extended.fitness = label.fitness + edge_valuations[last][next] + node_valuations[next];
+                    extended.prev_last = last;
+                    extended.prev_label = k;
+                    insert_label(labels[(subset | (1UL << (next - 1))) * m + next - 1], extended);
+                }
+            }
+        }
+    }
+
+    // rebuild the chromosome following the predecessors
+    if(best_label >= 0){
+        int last = best_last;
+        unsigned long subset = best_subset;
+        int k = best_label;
+        while(last > 0){
+            best.chromosome.push_back(last);
+            const Label &label = labels[subset * m + last - 1][k];
+            subset &= ~(1UL << (last - 1));
+            last = label.prev_last;
+            k = label.prev_label;
+        }
+        reverse(best.chromosome.begin(), best.chromosome.end());
+        best.size = best.chromosome.size();
+        best.feasible = true;
+    }
+
+    auto end = chrono::high_resolution_clock::now();
+    best.exec_time = end - start;
+    best.best_time = best.exec_time;
+
+    return best;
+}
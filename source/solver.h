@@ -6,6 +6,13 @@
 #include <random>
 #include <chrono>
 #include <cmath>
+#include <set>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <memory>
+#include <cstdio>
 
 using namespace std;
 
@@ -19,8 +26,30 @@ public:
         int tour_time; // tour time
         bool feasible;
         chrono::duration<double, milli> exec_time;
-        int iteration; // iteration that this solution was found
-        int last_iteration; // last iteration that the Solver executed
+        long iteration; // iteration (evaluation in steady-state) that this solution was found
+        long last_iteration; // last iteration (evaluation in steady-state) that the Solver executed
+        chrono::duration<double, milli> best_time; // time when this solution was found
+
+        // fields that are not given start at zero
+        Solution(vector<int> chromosome = vector<int>(), 
+                 unsigned long size = 0, 
+                 int fitness = 0, 
+                 int tour_time = 0, 
+                 bool feasible = true,
+                 chrono::duration<double, milli> exec_time = chrono::duration<double, milli>(0),
+                 long iteration = 0,
+                 long last_iteration = 0,
+                 chrono::duration<double, milli> best_time = chrono::duration<double, milli>(0))
+            : chromosome(chromosome), size(size), fitness(fitness), tour_time(tour_time), feasible(feasible),
+              exec_time(exec_time), iteration(iteration), last_iteration(last_iteration), best_time(best_time) {}
+    };
+
+    // label of the exact solver: a partial tour from the starting node ending at some node
+    struct Label {
+        int time; // time spent so far (dwell + travel)
+        int fitness; // score collected so far
+        int prev_last; // last node of the label this one extends (-1 if first node)
+        int prev_label; // index of that label in its state
     };
 
     // initialization parameters
@@ -34,10 +63,18 @@ public:
     // extra variables
     mt19937 gen; // random generator
     const int starting_node = 0;
+    const unsigned long exact_max_nodes = 18; // largest n solved by solve_exact
     int population_size;
     vector<Solution> population;
     Solution best_solution;
 
+    // checkpointing
+    string checkpoint_file; // empty: no checkpoints
+    int checkpoint_interval; // iterations between checkpoints (x population_size evaluations in steady-state)
+    bool resume; // continue from checkpoint_file if it exists
+    shared_ptr<thread> checkpoint_writer; // background write of the last checkpoint
+    string checkpoint_signature; // engine, instance and parameters of the current run
+
     // constructor, destructor
     Solver(int n, 
            vector<int> node_dwell_times, 
@@ -67,6 +104,8 @@ public:
 
     tuple<Solution, Solution> order_crossover(Solution parent1, Solution parent2);
 
+    tuple<Solution, Solution> crossover(Solution parent1, Solution parent2, bool orderX);
+
     Solution mutate(Solution solution);
 
     Solution calculate_fitness(Solution solution,
@@ -78,11 +117,46 @@ public:
 
     int spin_roulette_wheel(int total_fitness);
 
+    int tournament_selection();
+
     Solution solve(vector<int> node_valuations,
                    vector<vector<int>> edge_valuations, 
                    int available_time, 
                    float crossover_rate,
                    float mutation_rate, 
                    int population_size, 
-                   bool orderX=true);    
+                   bool orderX=true);
+
+    Solution solve_steady_state(vector<int> node_valuations,
+                                vector<vector<int>> edge_valuations,
+                                int available_time,
+                                float crossover_rate,
+                                float mutation_rate,
+                                int population_size,
+                                bool orderX=true);
+
+    void set_checkpoint_signature(bool steady_state,
+                                  vector<int> node_valuations,
+                                  vector<vector<int>> edge_valuations,
+                                  int available_time,
+                                  float crossover_rate,
+                                  float mutation_rate,
+                                  int population_size,
+                                  bool orderX);
+
+    void save_checkpoint(bool done, 
+                         long iteration, 
+                         long counter, 
+                         chrono::high_resolution_clock::time_point start);
+
+    bool load_checkpoint(long &iteration, 
+                         long &counter, 
+                         bool &done, 
+                         chrono::high_resolution_clock::time_point &start);
+
+    bool insert_label(vector<Label> &labels, Label label);
+
+    Solution solve_exact(vector<int> node_valuations,
+                         vector<vector<int>> edge_valuations,
+                         int available_time);
 };
\ No newline at end of file